@@ -21,6 +21,11 @@
 #include <sstream>
 #include <chrono>
 #include <stdexcept>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
 
 #define SHOCKTEST_VERSION "0.2.0"
 
@@ -51,6 +56,340 @@ inline void register_test(const std::string& name, std::function<void()> fn, boo
     registry().push_back({ name, fn, expect_fail });
 }
 
+//
+// !\brief A single complete ("ph":"X") span in the Chrome trace-event timeline.
+//
+// Names and outcomes are borrowed pointers so recording never allocates: user
+// scopes pass string literals and test spans point at registry-owned names.
+// Spans are discarded when the next traced run starts and the trace is written
+// before run_all returns, so the registry must only stay unchanged for the
+// duration of a traced run.
+//
+struct TraceEvent {
+    const char* name;
+    const char* cat;
+    const char* outcome;  // nullptr for user scopes
+    std::int64_t start_ns;
+    std::int64_t dur_ns;
+};
+
+//
+// !\brief Per-thread append-only event buffer.
+//
+// Only the owning thread appends. Chunks are allocated on first use, start small
+// and double up to MAX_CHUNK_EVENTS. Each chunk publishes its fill count with a
+// release store and links the next chunk the same way, so the writer can walk
+// every buffer without taking a lock. When a new traced run begins, the owner
+// rewinds its own chunks on the next push and keeps them for reuse.
+//
+struct TraceBuffer {
+    static constexpr std::size_t FIRST_CHUNK_EVENTS = 16;
+    static constexpr std::size_t MAX_CHUNK_EVENTS = 1024;
+
+    struct Chunk {
+        explicit Chunk(std::size_t cap) : capacity(cap), events(new TraceEvent[cap]) {}
+
+        const std::size_t capacity;
+        std::unique_ptr<TraceEvent[]> events;
+        std::atomic<std::size_t> count{0};
+        std::atomic<Chunk*> next{nullptr};
+    };
+
+    std::uint32_t tid = 0;                      // fixed before the buffer is published
+    TraceBuffer* next_buffer = nullptr;         // fixed before the buffer is published
+    std::atomic<bool> in_use{false};            // owned by a live thread
+    std::atomic<std::uint32_t> generation{0};   // traced run the events belong to
+    std::atomic<Chunk*> head{nullptr};
+    Chunk* tail = nullptr;                      // owner only
+
+    void push(const TraceEvent& ev, std::uint32_t gen) {
+        if (generation.load(std::memory_order_relaxed) != gen) {
+            for (Chunk* c = head.load(std::memory_order_relaxed); c; c = c->next.load(std::memory_order_relaxed)) {
+                c->count.store(0, std::memory_order_relaxed);
+            }
+            tail = head.load(std::memory_order_relaxed);
+            generation.store(gen, std::memory_order_release);
+        }
+        if (!tail) {
+            tail = new Chunk(FIRST_CHUNK_EVENTS);
+            head.store(tail, std::memory_order_release);
+        }
+        std::size_t n = tail->count.load(std::memory_order_relaxed);
+        if (n == tail->capacity) {
+            Chunk* next = tail->next.load(std::memory_order_relaxed);
+            if (!next) {
+                const std::size_t cap = tail->capacity * 2;
+                next = new Chunk(cap < MAX_CHUNK_EVENTS ? cap : MAX_CHUNK_EVENTS);
+                tail->next.store(next, std::memory_order_release);
+            }
+            tail = next;
+            n = 0;
+        }
+        tail->events[n] = ev;
+        tail->count.store(n + 1, std::memory_order_release);
+    }
+};
+
+//
+// !\brief Global trace state: enable flag, run generation, time origin and buffer list.
+//
+// Buffers are pushed onto an intrusive lock-free list and never freed. A thread
+// releases its buffer on exit and the next new thread reuses it, so short-lived
+// threads share a timeline track instead of each allocating a buffer.
+//
+struct TraceState {
+    std::atomic<bool> enabled{false};
+    std::atomic<std::uint32_t> generation{0};
+    std::atomic<std::int64_t> origin_ns{0};
+    std::atomic<TraceBuffer*> buffers{nullptr};
+    std::atomic<std::uint32_t> next_tid{1};
+};
+
+//
+// !\brief Returns the process-wide trace state.
+//
+// Intentionally leaked: threads still running during static destruction may
+// record spans, so the state and its buffers must never be destroyed.
+//
+inline TraceState& trace_state() {
+    static TraceState& state = *new TraceState;
+    return state;
+}
+
+//
+// !\brief Returns true when spans are being recorded.
+//
+inline bool trace_enabled() {
+    return trace_state().enabled.load(std::memory_order_acquire);
+}
+
+//
+// !\brief Raw steady clock reading in nanoseconds.
+//
+inline std::int64_t trace_clock_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//
+// !\brief Starts a new traced run, discarding spans from any earlier run.
+//
+inline void trace_begin() {
+    TraceState& state = trace_state();
+    state.origin_ns.store(trace_clock_ns(), std::memory_order_relaxed);
+    state.generation.fetch_add(1, std::memory_order_release);
+    state.enabled.store(true, std::memory_order_release);
+}
+
+//
+// !\brief Stops recording spans.
+//
+inline void trace_end() {
+    trace_state().enabled.store(false, std::memory_order_release);
+}
+
+//
+// !\brief Claims a buffer released by an exited thread, or registers a new one.
+//
+inline TraceBuffer* trace_acquire_buffer() {
+    TraceState& state = trace_state();
+    for (TraceBuffer* b = state.buffers.load(std::memory_order_acquire); b; b = b->next_buffer) {
+        bool expected = false;
+        if (!b->in_use.load(std::memory_order_relaxed) &&
+            b->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return b;
+        }
+    }
+
+    TraceBuffer* buffer = new TraceBuffer();
+    buffer->tid = state.next_tid.fetch_add(1, std::memory_order_relaxed);
+    buffer->in_use.store(true, std::memory_order_relaxed);
+    TraceBuffer* head = state.buffers.load(std::memory_order_relaxed);
+    do {
+        buffer->next_buffer = head;
+    } while (!state.buffers.compare_exchange_weak(
+        head, buffer, std::memory_order_release, std::memory_order_relaxed));
+    return buffer;
+}
+
+//
+// !\brief Holds the calling thread's buffer and releases it for reuse on thread exit.
+//
+struct TraceBufferLease {
+    TraceBuffer* buffer = nullptr;
+    bool released = false;
+
+    ~TraceBufferLease() {
+        if (buffer) {
+            buffer->in_use.store(false, std::memory_order_release);
+            buffer = nullptr;
+        }
+        released = true;
+    }
+};
+
+//
+// !\brief Returns the calling thread's buffer, claiming one on first use.
+//
+// Returns nullptr once the thread's lease has been destroyed, so spans closed
+// by later thread_local destructors are dropped instead of racing with the
+// buffer's next owner.
+//
+inline TraceBuffer* trace_buffer() {
+    thread_local TraceBufferLease lease;
+    if (!lease.buffer && !lease.released) {
+        lease.buffer = trace_acquire_buffer();
+    }
+    return lease.buffer;
+}
+
+//
+// !\brief Start of a span: the traced run it belongs to and that run's clock origin.
+//
+struct TraceMark {
+    bool active = false;
+    std::uint32_t generation = 0;
+    std::int64_t origin_ns = 0;
+    std::int64_t start_ns = 0;  // raw clock
+};
+
+//
+// !\brief Opens a span, capturing the run state it will be filed under.
+//
+inline TraceMark trace_mark() {
+    TraceMark mark;
+    TraceState& state = trace_state();
+    if (!state.enabled.load(std::memory_order_acquire)) {
+        return mark;
+    }
+    mark.active = true;
+    mark.generation = state.generation.load(std::memory_order_acquire);
+    mark.origin_ns = state.origin_ns.load(std::memory_order_relaxed);
+    mark.start_ns = trace_clock_ns();
+    return mark;
+}
+
+//
+// !\brief Closes a span opened by trace_mark and records it on the calling thread.
+//
+// Spans opened under an earlier traced run are dropped: their timestamps are
+// relative to a different origin and their run's trace is already written.
+//
+inline void trace_record(const TraceMark& mark, const char* name, const char* cat, const char* outcome) {
+    if (!mark.active ||
+        trace_state().generation.load(std::memory_order_relaxed) != mark.generation) {
+        return;
+    }
+    const std::int64_t end_ns = trace_clock_ns();
+    if (TraceBuffer* buffer = trace_buffer()) {
+        buffer->push({ name, cat, outcome, mark.start_ns - mark.origin_ns, end_ns - mark.start_ns },
+                     mark.generation);
+    }
+}
+
+//
+// !\brief RAII span used by SHOCKTEST_TRACE_SCOPE.
+//
+class TraceScope {
+public:
+    explicit TraceScope(const char* name)
+        : name_(name), mark_(trace_mark()) {}
+
+    ~TraceScope() {
+        trace_record(mark_, name_, "scope", nullptr);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    TraceMark mark_;
+};
+
+//
+// !\brief Writes a JSON string literal with the required escapes.
+//
+inline void trace_write_json_string(std::ostream& os, const char* s) {
+    os << '"';
+    for (; *s; ++s) {
+        const unsigned char c = static_cast<unsigned char>(*s);
+        switch (c) {
+            case '"':  os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            case '\n': os << "\\n"; break;
+            case '\r': os << "\\r"; break;
+            case '\t': os << "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    static constexpr const char* HEX = "0123456789abcdef";
+                    os << "\\u00" << HEX[c >> 4] << HEX[c & 0xf];
+                } else {
+                    os << *s;
+                }
+        }
+    }
+    os << '"';
+}
+
+//
+// !\brief Writes a nanosecond value as fractional microseconds.
+//
+inline void trace_write_us(std::ostream& os, std::int64_t ns) {
+    if (ns < 0) {
+        os << '-';
+        ns = -ns;
+    }
+    os << ns / 1000 << '.';
+    const std::int64_t frac = ns % 1000;
+    if (frac < 100) os << '0';
+    if (frac < 10) os << '0';
+    os << frac;
+}
+
+//
+// !\brief Writes every span of the current traced run as Chrome/Perfetto trace-event JSON.
+//
+inline bool trace_write(const std::string& path) {
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"shocktest\"}}";
+
+    const std::uint32_t gen = trace_state().generation.load(std::memory_order_relaxed);
+    for (TraceBuffer* b = trace_state().buffers.load(std::memory_order_acquire); b; b = b->next_buffer) {
+        if (b->generation.load(std::memory_order_acquire) != gen) {
+            continue;  // no spans in this run
+        }
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid
+            << ",\"args\":{\"name\":\"thread " << b->tid << "\"}}";
+
+        for (const TraceBuffer::Chunk* c = b->head.load(std::memory_order_acquire); c; c = c->next.load(std::memory_order_acquire)) {
+            const std::size_t n = c->count.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < n; ++i) {
+                const TraceEvent& ev = c->events[i];
+                out << ",\n{\"name\":";
+                trace_write_json_string(out, ev.name);
+                out << ",\"cat\":\"" << ev.cat << "\",\"ph\":\"X\",\"ts\":";
+                trace_write_us(out, ev.start_ns);
+                out << ",\"dur\":";
+                trace_write_us(out, ev.dur_ns);
+                out << ",\"pid\":1,\"tid\":" << b->tid;
+                if (ev.outcome) {
+                    out << ",\"args\":{\"outcome\":\"" << ev.outcome << "\"}";
+                }
+                out << '}';
+            }
+        }
+    }
+
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
 //
 // !\brief Runs all tests and prints a weather report.
 //
@@ -73,6 +412,9 @@ inline int run_all() {
         // Simply show BADWEATHER if flagged, otherwise GOODWEATHER.
         std::string weatherLabel = test.expect_fail ? "\033[31mBADWEATHER\033[0m " : "\033[32mGOODWEATHER\033[0m ";
 
+        const TraceMark trace_mark_start = trace_mark();
+        const char* outcome = "pass";
+
         auto start = steady_clock::now();
         std::cout << LABEL_RUN << " " << weatherLabel << test.name << " ... " << std::endl << std::flush;
         
@@ -97,6 +439,7 @@ inline int run_all() {
             } else {
                 std::cout << "\n" << LABEL_FAIL << " " << weatherLabel << test.name
                           << " - " << e.what() << " (" << dt << " ms)" << std::endl;
+                outcome = "fail";
                 ++failures;
             }
         } catch (...) {
@@ -108,9 +451,13 @@ inline int run_all() {
             } else {
                 std::cout << "\n" << LABEL_FAIL << " " << weatherLabel << test.name
                           << " - unknown error (" << dt << " ms)" << std::endl;
+                outcome = "fail";
                 ++failures;
             }
         }
+
+        trace_record(trace_mark_start, test.name.c_str(),
+                     test.expect_fail ? "badweather" : "goodweather", outcome);
     }
 
     std::cout << LABEL_HEADER << " " << total << " tests ran.\n";
@@ -122,6 +469,51 @@ inline int run_all() {
     return failures;
 }
 
+//
+// !\brief Runs all tests, honouring command line options.
+//
+// Supported options:
+//   --trace <file>   write a Chrome/Perfetto trace-event JSON timeline to file
+//
+// Unrecognised arguments are ignored so custom mains can forward argv as-is.
+//
+inline int run_all(int argc, char** argv) {
+    std::string trace_path;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = nullptr;
+        if (std::strcmp(arg, "--trace") == 0) {
+            value = (i + 1 < argc) ? argv[++i] : "";
+        } else if (std::strncmp(arg, "--trace=", 8) == 0) {
+            value = arg + 8;
+        } else {
+            continue;
+        }
+        if (value[0] == '\0' || value[0] == '-') {
+            std::cerr << "shocktest: --trace requires a file argument" << std::endl;
+            return 1;
+        }
+        trace_path = value;
+    }
+
+    if (!trace_path.empty()) {
+        trace_begin();
+    }
+
+    int failures = run_all();
+
+    if (!trace_path.empty()) {
+        trace_end();
+        if (!trace_write(trace_path)) {
+            std::cerr << "shocktest: failed to write trace to " << trace_path << std::endl;
+            if (failures == 0) {
+                failures = 1;
+            }
+        }
+    }
+    return failures;
+}
+
 //
 //!\brief Captures output written to a standard stream while executing fn.
 //
@@ -157,6 +549,17 @@ inline void expect_stream_eq(
 
 // --- Macros ---
 
+#define SHOCKTEST_TRACE_CONCAT_INNER(a, b) a##b
+#define SHOCKTEST_TRACE_CONCAT(a, b) SHOCKTEST_TRACE_CONCAT_INNER(a, b)
+
+//
+// !\brief SHOCKTEST_TRACE_SCOPE records a nested span until the end of the enclosing scope.
+//
+// name must be a string literal (or otherwise outlive the run). No-op unless --trace is given.
+//
+#define SHOCKTEST_TRACE_SCOPE(name) \
+    shocktest::TraceScope SHOCKTEST_TRACE_CONCAT(_shocktest_trace_scope_, __LINE__)(name)
+
 //
 // !\brief SHOCKTEST_CASE registers a test expected to pass (good weather).
 //
@@ -355,8 +758,8 @@ inline void expect_stream_eq(
 } // namespace shocktest
 
 #ifndef SHOCKTEST_CUSTOM_MAIN
-int main() {
-    return shocktest::run_all();
+int main(int argc, char** argv) {
+    return shocktest::run_all(argc, argv);
 }
 #endif
 
@@ -0,0 +1,501 @@
+// -------------------------------------------------------------
+//
+//!\file test_trace.cpp
+//!\brief Unit tests for the --trace Chrome trace-event timeline export.
+//!\author Colin J.D. Stewart
+//
+// -------------------------------------------------------------
+//
+//            Copyright (c) 2026. Colin J.D. Stewart
+//                   All rights reserved
+//
+// -------------------------------------------------------------
+
+// let shocktest know we are providing our own main function
+#define SHOCKTEST_CUSTOM_MAIN
+
+// shocktest
+#include "shocktest.hpp"
+
+// system
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+//
+//!\brief Minimal JSON value, enough to check the shape of a trace file.
+//
+struct Json {
+    enum class Kind { Null, Bool, Number, String, Array, Object };
+
+    Kind kind = Kind::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<Json> array;
+    std::vector<std::pair<std::string, Json>> object;
+
+    const Json* get(const std::string& key) const {
+        for (const auto& member : object) {
+            if (member.first == key) return &member.second;
+        }
+        return nullptr;
+    }
+};
+
+//
+//!\brief Strict recursive-descent JSON parser; throws on malformed input.
+//
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : text_(text) {}
+
+    Json parse() {
+        Json value = parse_value();
+        skip_ws();
+        if (pos_ != text_.size()) fail("trailing characters");
+        return value;
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::runtime_error("JSON parse error at " + std::to_string(pos_) + ": " + what);
+    }
+
+    void skip_ws() {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) ++pos_;
+    }
+
+    void expect(char c) {
+        skip_ws();
+        if (pos_ >= text_.size() || text_[pos_] != c) fail(std::string("expected '") + c + "'");
+        ++pos_;
+    }
+
+    bool consume(const char* word) {
+        const std::string w(word);
+        if (text_.compare(pos_, w.size(), w) != 0) return false;
+        pos_ += w.size();
+        return true;
+    }
+
+    Json parse_value() {
+        skip_ws();
+        if (pos_ >= text_.size()) fail("unexpected end");
+        Json v;
+        const char c = text_[pos_];
+        if (c == '{') {
+            v.kind = Json::Kind::Object;
+            ++pos_;
+            skip_ws();
+            if (pos_ < text_.size() && text_[pos_] == '}') { ++pos_; return v; }
+            do {
+                skip_ws();
+                std::string key = parse_string();
+                expect(':');
+                if (v.get(key)) fail("duplicate key " + key);
+                v.object.emplace_back(std::move(key), parse_value());
+                skip_ws();
+            } while (pos_ < text_.size() && text_[pos_] == ',' && ++pos_);
+            expect('}');
+        } else if (c == '[') {
+            v.kind = Json::Kind::Array;
+            ++pos_;
+            skip_ws();
+            if (pos_ < text_.size() && text_[pos_] == ']') { ++pos_; return v; }
+            do {
+                v.array.push_back(parse_value());
+                skip_ws();
+            } while (pos_ < text_.size() && text_[pos_] == ',' && ++pos_);
+            expect(']');
+        } else if (c == '"') {
+            v.kind = Json::Kind::String;
+            v.string = parse_string();
+        } else if (consume("true")) {
+            v.kind = Json::Kind::Bool;
+            v.boolean = true;
+        } else if (consume("false")) {
+            v.kind = Json::Kind::Bool;
+        } else if (consume("null")) {
+            v.kind = Json::Kind::Null;
+        } else {
+            const std::size_t start = pos_;
+            while (pos_ < text_.size() && std::strchr("+-0123456789.eE", text_[pos_])) ++pos_;
+            if (start == pos_) fail("unexpected character");
+            v.kind = Json::Kind::Number;
+            v.number = std::stod(text_.substr(start, pos_ - start));
+        }
+        return v;
+    }
+
+    std::string parse_string() {
+        if (pos_ >= text_.size() || text_[pos_] != '"') fail("expected string");
+        ++pos_;
+        std::string out;
+        while (pos_ < text_.size() && text_[pos_] != '"') {
+            char c = text_[pos_++];
+            if (static_cast<unsigned char>(c) < 0x20) fail("control character in string");
+            if (c == '\\') {
+                if (pos_ >= text_.size()) fail("bad escape");
+                c = text_[pos_++];
+                switch (c) {
+                    case '"': case '\\': case '/': out += c; break;
+                    case 'n': out += '\n'; break;
+                    case 'r': out += '\r'; break;
+                    case 't': out += '\t'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'u':
+                        if (pos_ + 4 > text_.size()) fail("bad unicode escape");
+                        out += static_cast<char>(std::stoi(text_.substr(pos_, 4), nullptr, 16));
+                        pos_ += 4;
+                        break;
+                    default: fail("bad escape");
+                }
+            } else {
+                out += c;
+            }
+        }
+        expect('"');
+        return out;
+    }
+
+    const std::string& text_;
+    std::size_t pos_ = 0;
+};
+
+//
+//!\brief A complete span extracted from a parsed trace.
+//
+struct Span {
+    std::string name;
+    std::string cat;
+    std::string outcome;
+    double ts;
+    double dur;
+    long tid;
+};
+
+//
+//!\brief Runs all registered tests with the given arguments while suppressing console output.
+//
+int run_all_quiet(int argc, char** argv) {
+    std::ostringstream out_sink;
+    std::ostringstream err_sink;
+    std::streambuf* old_out = std::cout.rdbuf(out_sink.rdbuf());
+    std::streambuf* old_err = std::cerr.rdbuf(err_sink.rdbuf());
+    const int rc = shocktest::run_all(argc, argv);
+    std::cout.rdbuf(old_out);
+    std::cerr.rdbuf(old_err);
+    return rc;
+}
+
+//
+//!\brief Runs all registered tests with a single command line argument.
+//
+int run_with_arg(const std::string& arg) {
+    std::string arg0 = "test_trace";
+    std::string arg1 = arg;
+    char* argv[] = { arg0.data(), arg1.data() };
+    return run_all_quiet(2, argv);
+}
+
+//
+//!\brief Runs all registered tests with --trace writing to path.
+//
+int run_traced(const std::string& path) {
+    std::remove(path.c_str());
+    std::string arg0 = "test_trace";
+    std::string arg1 = "--trace";
+    std::string arg2 = path;
+    char* argv[] = { arg0.data(), arg1.data(), arg2.data() };
+    return run_all_quiet(3, argv);
+}
+
+//
+//!\brief Reads a whole file into a string, empty if it cannot be opened.
+//
+std::string read_file(const std::string& path) {
+    std::ifstream in(path);
+    std::ostringstream oss;
+    oss << in.rdbuf();
+    return oss.str();
+}
+
+//
+//!\brief Parses a trace file, checks the shape of every event and returns the complete spans.
+//
+std::vector<Span> load_spans(const std::string& path) {
+    const std::string text = read_file(path);
+    const Json root = JsonParser(text).parse();
+    if (root.kind != Json::Kind::Object) throw std::runtime_error("trace root is not an object");
+
+    const Json* events = root.get("traceEvents");
+    if (!events || events->kind != Json::Kind::Array) throw std::runtime_error("traceEvents is not an array");
+
+    std::vector<Span> spans;
+    for (const Json& ev : events->array) {
+        const Json* name = ev.get("name");
+        const Json* ph = ev.get("ph");
+        const Json* pid = ev.get("pid");
+        const Json* tid = ev.get("tid");
+        if (!name || name->kind != Json::Kind::String || !ph || ph->kind != Json::Kind::String ||
+            !pid || pid->kind != Json::Kind::Number || !tid || tid->kind != Json::Kind::Number) {
+            throw std::runtime_error("event missing name/ph/pid/tid");
+        }
+        if (ph->string == "M") {
+            continue;
+        }
+        if (ph->string != "X") throw std::runtime_error("unexpected phase " + ph->string);
+
+        const Json* cat = ev.get("cat");
+        const Json* ts = ev.get("ts");
+        const Json* dur = ev.get("dur");
+        if (!cat || cat->kind != Json::Kind::String || !ts || ts->kind != Json::Kind::Number ||
+            !dur || dur->kind != Json::Kind::Number || ts->number < 0 || dur->number < 0) {
+            throw std::runtime_error("span " + name->string + " has bad cat/ts/dur");
+        }
+
+        Span span{ name->string, cat->string, "", ts->number, dur->number, static_cast<long>(tid->number) };
+        if (const Json* args = ev.get("args")) {
+            if (const Json* outcome = args->get("outcome")) span.outcome = outcome->string;
+        }
+        spans.push_back(span);
+    }
+    return spans;
+}
+
+//
+//!\brief Returns the single span with the given name, throwing if absent or duplicated.
+//
+const Span& find_span(const std::vector<Span>& spans, const std::string& name) {
+    const Span* found = nullptr;
+    for (const Span& s : spans) {
+        if (s.name == name) {
+            if (found) throw std::runtime_error("duplicate span " + name);
+            found = &s;
+        }
+    }
+    if (!found) throw std::runtime_error("missing span " + name);
+    return *found;
+}
+
+//
+//!\brief Returns true when inner lies entirely within outer on the timeline.
+//
+bool contains_span(const Span& outer, const Span& inner) {
+    return inner.ts >= outer.ts && inner.ts + inner.dur <= outer.ts + outer.dur;
+}
+
+//
+//!\brief Counts the trace buffers registered so far.
+//
+int registered_buffers() {
+    int n = 0;
+    for (auto* b = shocktest::trace_state().buffers.load(); b; b = b->next_buffer) ++n;
+    return n;
+}
+
+//
+//!\brief A scope opened during one traced run and closed during the next.
+//
+std::unique_ptr<shocktest::TraceScope> cross_run_scope;
+
+//
+//!\brief Registers a mix of passing, failing and multi-threaded tests with nested scopes.
+//
+void register_traced_tests() {
+    shocktest::registry().clear();
+    shocktest::register_test("traced_pass", [] {
+        SHOCKTEST_TRACE_SCOPE("outer_scope");
+        {
+            SHOCKTEST_TRACE_SCOPE("inner_scope");
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }, false);
+    shocktest::register_test("traced_fail", [] { throw std::runtime_error("boom"); }, false);
+    shocktest::register_test("traced_worker", [] {
+        std::thread worker([] {
+            SHOCKTEST_TRACE_SCOPE("worker_scope");
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        });
+        worker.join();
+    }, false);
+}
+
+//
+//!\brief Verifies that without --trace no file is written and scopes register no buffers.
+//
+// Must run before any traced run so that the buffer list is still empty.
+//
+int verify_trace_disabled(const std::string& path) {
+    std::remove(path.c_str());
+    register_traced_tests();
+
+    std::string arg0 = "test_trace";
+    char* argv[] = { arg0.data() };
+    run_all_quiet(1, argv);
+
+    if (std::ifstream(path)) {
+        std::cerr << "Trace file written without --trace\n";
+        return 1;
+    }
+    if (registered_buffers() != 0) {
+        std::cerr << "Trace buffers registered without --trace\n";
+        return 1;
+    }
+    return 0;
+}
+
+//
+//!\brief Verifies test spans, outcomes, scope nesting and worker thread spans in a parsed trace.
+//
+int verify_trace_written(const std::string& path) {
+    register_traced_tests();
+    if (run_traced(path) != 1) {
+        std::cerr << "Expected exactly one failing test\n";
+        return 1;
+    }
+
+    try {
+        const std::vector<Span> spans = load_spans(path);
+        if (spans.size() != 6) throw std::runtime_error("expected 6 spans, got " + std::to_string(spans.size()));
+
+        const Span& pass = find_span(spans, "traced_pass");
+        const Span& fail = find_span(spans, "traced_fail");
+        const Span& worker = find_span(spans, "traced_worker");
+        const Span& outer = find_span(spans, "outer_scope");
+        const Span& inner = find_span(spans, "inner_scope");
+        const Span& worker_scope = find_span(spans, "worker_scope");
+
+        if (pass.cat != "goodweather" || pass.outcome != "pass") throw std::runtime_error("traced_pass cat/outcome");
+        if (fail.outcome != "fail") throw std::runtime_error("traced_fail outcome");
+        if (worker.outcome != "pass") throw std::runtime_error("traced_worker outcome");
+        if (outer.cat != "scope" || !outer.outcome.empty()) throw std::runtime_error("outer_scope cat/args");
+
+        if (!contains_span(pass, outer)) throw std::runtime_error("outer_scope not within traced_pass");
+        if (!contains_span(outer, inner)) throw std::runtime_error("inner_scope not within outer_scope");
+        if (!contains_span(worker, worker_scope)) throw std::runtime_error("worker_scope not within traced_worker");
+        if (inner.dur <= 0 || worker_scope.dur <= 0) throw std::runtime_error("scope durations not recorded");
+
+        if (outer.tid != pass.tid || inner.tid != pass.tid) throw std::runtime_error("scopes on wrong thread");
+        if (worker_scope.tid == worker.tid) throw std::runtime_error("worker_scope on the test thread");
+        if (pass.tid != fail.tid || pass.tid != worker.tid) throw std::runtime_error("tests on different threads");
+    } catch (const std::exception& e) {
+        std::cerr << "Trace check failed: " << e.what() << "\n" << read_file(path) << "\n";
+        return 1;
+    }
+    std::remove(path.c_str());
+    return 0;
+}
+
+//
+//!\brief Verifies that a second traced run only contains its own spans, even after the registry
+//!       changed and a scope opened in the first run closes during the second.
+//
+int verify_trace_twice(const std::string& path) {
+    register_traced_tests();
+    shocktest::register_test("open_cross_run_scope", [] {
+        cross_run_scope = std::make_unique<shocktest::TraceScope>("cross_run_scope");
+    }, false);
+    run_traced(path);
+
+    shocktest::registry().clear();
+    shocktest::register_test("second_run_only_test_with_a_long_heap_allocated_name", [] {
+        SHOCKTEST_TRACE_SCOPE("second_scope");
+        cross_run_scope.reset();
+    }, false);
+    if (run_traced(path) != 0) {
+        std::cerr << "Expected second traced run to pass\n";
+        return 1;
+    }
+
+    try {
+        const std::vector<Span> spans = load_spans(path);
+        if (spans.size() != 2) throw std::runtime_error("expected 2 spans, got " + std::to_string(spans.size()));
+        const Span& test = find_span(spans, "second_run_only_test_with_a_long_heap_allocated_name");
+        const Span& scope = find_span(spans, "second_scope");
+        if (!contains_span(test, scope)) throw std::runtime_error("second_scope not within its test");
+    } catch (const std::exception& e) {
+        std::cerr << "Second trace check failed: " << e.what() << "\n" << read_file(path) << "\n";
+        return 1;
+    }
+    std::remove(path.c_str());
+    return 0;
+}
+
+//
+//!\brief Verifies that negative timestamps are still written as valid JSON numbers.
+//
+int verify_trace_write_negative() {
+    std::ostringstream oss;
+    shocktest::trace_write_us(oss, -1500);
+    oss << ' ';
+    shocktest::trace_write_us(oss, -7);
+    if (oss.str() != "-1.500 -0.007") {
+        std::cerr << "Unexpected negative timestamp format: " << oss.str() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+//
+//!\brief Verifies that --trace without a usable file argument is rejected.
+//
+int verify_trace_bad_path() {
+    shocktest::registry().clear();
+    const std::vector<std::string> bad = { "--trace", "--trace=", "--trace=-x" };
+    for (const std::string& arg : bad) {
+        if (run_with_arg(arg) == 0) {
+            std::cerr << "Expected " << arg << " to return non-zero\n";
+            return 1;
+        }
+    }
+
+    std::string arg0 = "test_trace";
+    std::string arg1 = "--trace";
+    std::string arg2 = "--other";
+    char* argv[] = { arg0.data(), arg1.data(), arg2.data() };
+    if (run_all_quiet(3, argv) == 0) {
+        std::cerr << "Expected --trace --other to return non-zero\n";
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+//
+//!\brief Custom main used to validate trace export scenarios.
+//
+int main() {
+    const std::string path = "shocktest_trace_ut.json";
+
+    if (verify_trace_disabled(path) != 0) {
+        return 1;
+    }
+    if (verify_trace_written(path) != 0) {
+        return 1;
+    }
+    if (verify_trace_twice(path) != 0) {
+        return 1;
+    }
+    if (verify_trace_write_negative() != 0) {
+        return 1;
+    }
+    if (verify_trace_bad_path() != 0) {
+        return 1;
+    }
+    return 0;
+}